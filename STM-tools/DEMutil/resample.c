@@ -12,234 +12,363 @@
  *
  * I've reformatted it to make it more readable.   -- Michael Garland
  *
+ * The nearest points are now found through a grid of buckets rather
+ * than by checking every point of the DEM for every output sample, the
+ * rows are resampled in parallel, and the result is written as STM.
  */
 
 /*  This is a resample program for USGS DEM Quads */
 
+/*
+ * Usage: resample [options] output input.dat
+ *
+ * The input is a DEM as convert writes it.  Its elevations are placed
+ * at the start of their profile, spaced along it by the input spacing,
+ * and resampled on a square grid covering the corners of the DEM, from
+ * the northwest corner east and south.  Each output sample is the
+ * average of the k nearest elevations, weighted by 1/distance^power.
+ *
+ *	-s <spacing>	output spacing [default=30]
+ *	-S <spacing>	spacing of the samples along a profile [default=30]
+ *	-k <k>		number of neighbors [default=6]
+ *	-p <power>	power of the distance weights [default=1]
+ *	-t <threads>	number of threads [default=one per processor]
+ *	-text		write rows of integers rather than STM
+ *
+ * Equally distant neighbors are taken in the order of the input, as
+ * the original exhaustive search took them.
+ */
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <float.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "../stmops.h"
 
-FILE *fin, *fout;
+#define MAX_K 64
 
-void define_DEM( void );
-void resample_DEM( void );
+typedef struct {	/* a DEM sample */
+    double x, y;
+    float z;
+} point;
 
-float *dem_x, *dem_y, *dem_z;
+point *pts;		/* all of the samples, in the order read */
+int count = 0;
 
-float xul=FLT_MAX, yul=FLT_MIN, xlr=FLT_MIN, ylr=FLT_MAX;
-char filein[80], fileout[80];
-float mean1, mean2, mean3, total1, total2, total3;
+double xul=DBL_MAX, yul=-DBL_MAX, xlr=-DBL_MAX, ylr=DBL_MAX;
 
-int count=0, command=0;
-float emax, emin;
+/* the grid: bucket (i,j) holds pts[cell_start[c]..cell_start[c+1]-1] */
+/* of cell_pts, in order, where c = j*gw + i */
+double gx0, gy0, cell;
+int gw, gh;
+int *cell_start, *cell_pts;
 
-/*-----------------------------------------------*/
-main( int argc, char *argv[] )
+double out_spacing = 30.0, in_spacing = 30.0, power = 1.0;
+int k = 6, nthreads = 0, text = 0;
+
+int width, height;	/* of the output */
+unsigned short *out;
+int next_row = 0;
+pthread_mutex_t row_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/*------------------------------------------------------------*/
+void *xmalloc(long size)
 {
+    void *p = malloc(size ? size : 1);
 
-    if( argc > 1 )
-    {  
-	command=1;
-	strcpy( filein, argv[2] );
-	strcpy( fileout, argv[1] );
+    if( !p ) {
+	fprintf(stderr, "resample: out of memory\n");
+	exit(1);
     }
+    return p;
+}
 
-    define_DEM();
+/*------------------------------------------------------------*/
+void define_DEM(char *filename)
+{
+    FILE *fin;
+    int xmax, num, i, j, elev, maxcount;
+    double x, y, startx, starty, emin, emax;
 
-    resample_DEM();
+    if( (fin = fopen(filename, "r"))==NULL ) {
+	fprintf(stderr, "resample: can't open %s\n", filename);
+	exit(1);
+    }
 
-    free( (float *)dem_x );
-    free( (float *)dem_y );
-    free( (float *)dem_z );
+    for(i=0; i<4; i++) {
+	fscanf(fin, "%lf", &x);
+	fscanf(fin, "%lf", &y);
+	if( x<xul ) xul = x;
+	if( y>yul ) yul = y;
+	if( x>xlr ) xlr = x;
+	if( y<ylr ) ylr = y;
+    }
+    fprintf(stderr, "DEM Dimensions are [%.3f, %.3f] --> [%.3f, %.3f]\n",
+	    xul, yul, xlr, ylr);
 
-    return 0;
+    fscanf(fin, "%lf", &emin);		/* Throw away the min and max */
+    fscanf(fin, "%lf", &emax);
+
+    if( fscanf(fin, "%d", &xmax)!=1 ) {	/* How many profiles are there? */
+	fprintf(stderr, "resample: %s is not a converted DEM\n", filename);
+	exit(1);
+    }
+
+    maxcount = 1024;
+    pts = (point *)xmalloc(maxcount*sizeof(point));
+    for(i=0; i<xmax; i++) {
+	fscanf(fin, "%d", &num);	/* profile number */
+	if( fscanf(fin, "%d", &num)!=1	/* number of elements */
+	    || fscanf(fin, "%lf %lf", &startx, &starty)!=2 ) {
+	    fprintf(stderr, "resample: %s is truncated\n", filename);
+	    exit(1);
+	}
+	if( count+num > maxcount ) {
+	    while( count+num > maxcount )
+		maxcount *= 2;
+	    pts = (point *)realloc(pts, maxcount*sizeof(point));
+	    if( !pts ) {
+		fprintf(stderr, "resample: out of memory\n");
+		exit(1);
+	    }
+	}
+	for(j=0; j<num; j++) {
+	    if( fscanf(fin, "%d", &elev)!=1 ) {
+		fprintf(stderr, "resample: %s is truncated\n", filename);
+		exit(1);
+	    }
+	    pts[count].x = startx;
+	    pts[count].y = starty + j*in_spacing;
+	    pts[count].z = elev;
+	    count++;
+	}
+    }
+    fclose(fin);
 }
 
 /*------------------------------------------------------------*/
-float max( float x1, float x2)
+/* Sorts the samples into buckets of about four each, keeping their order */
+void build_grid(void)
 {
-    if( x1 > x2 ) return( x1);
-    return( x2);
+    double x1 = -DBL_MAX, y1 = -DBL_MAX;
+    int i, c;
+
+    gx0 = gy0 = DBL_MAX;
+    for(i=0; i<count; i++) {
+	if( pts[i].x<gx0 ) gx0 = pts[i].x;
+	if( pts[i].y<gy0 ) gy0 = pts[i].y;
+	if( pts[i].x>x1 ) x1 = pts[i].x;
+	if( pts[i].y>y1 ) y1 = pts[i].y;
+    }
+    cell = sqrt(4.0*(x1-gx0+in_spacing)*(y1-gy0+in_spacing)/count);
+    gw = (int)((x1-gx0)/cell) + 1;
+    gh = (int)((y1-gy0)/cell) + 1;
+
+    cell_start = (int *)xmalloc(((long)gw*gh+1)*sizeof(int));
+    cell_pts = (int *)xmalloc((long)count*sizeof(int));
+    memset(cell_start, 0, ((long)gw*gh+1)*sizeof(int));
+
+    for(i=0; i<count; i++)
+	cell_start[(int)((pts[i].y-gy0)/cell)*gw
+		   + (int)((pts[i].x-gx0)/cell) + 1]++;
+    for(c=0; c<gw*gh; c++)
+	cell_start[c+1] += cell_start[c];
+    for(i=0; i<count; i++) {
+	c = (int)((pts[i].y-gy0)/cell)*gw + (int)((pts[i].x-gx0)/cell);
+	cell_pts[cell_start[c]++] = i;
+    }
+    for(c=gw*gh; c>0; c--)		/* undo the increments */
+	cell_start[c] = cell_start[c-1];
+    cell_start[0] = 0;
 }
 
 /*------------------------------------------------------------*/
-float min( float x1, float x2)
+/* Inserts sample i, at distance d, into the k nearest so far, which */
+/* are ordered by distance and then by their order in the input. */
+void consider(int i, double d, double *best, int *besti, int *n)
 {
-    if( x1 < x2 ) return( x1 );
-    return( x2);
+    int j;
+
+    if( *n==k && (d>best[k-1] || (d==best[k-1] && i>besti[k-1])) )
+	return;
+    j = *n<k ? (*n)++ : k-1;
+    for(; j>0 && (d<best[j-1] || (d==best[j-1] && i<besti[j-1])); j--) {
+	best[j] = best[j-1];
+	besti[j] = besti[j-1];
+    }
+    best[j] = d;
+    besti[j] = i;
 }
 
 /*------------------------------------------------------------*/
-void define_DEM( void )
+void consider_bucket(int i, int j, double xs, double ys,
+		     double *best, int *besti, int *n)
 {
-    char filename[80];
-    int xmax, num;
-    int i, elev;
-    float x, y, startx, starty;
-
-    if( ! command )
-    {
-	printf("Please Enter the Name of the DEM to resample\n");
-	scanf("%s", filename );
-    }
-    else
-    {
-	strcpy( filename, filein );
+    int c = j*gw + i, q;
+    point *p;
+
+    if( i<0 || i>=gw )
+	return;
+    for(q=cell_start[c]; q<cell_start[c+1]; q++) {
+	p = &pts[cell_pts[q]];
+	consider(cell_pts[q], sqrt((p->x-xs)*(p->x-xs) + (p->y-ys)*(p->y-ys)),
+		 best, besti, n);
     }
+}
 
-    if( (fin = fopen(filename, "rt") )==NULL)
-    {
-	printf("Can't Open %s\n", filename );
-	exit(0);
+/*------------------------------------------------------------*/
+/* The weighted average of the k samples nearest (xs,ys) */
+double estimate(double xs, double ys)
+{
+    double best[MAX_K], sum = 0, wsum = 0, w;
+    int besti[MAX_K], n = 0, r, r0, rmax, i, j, q, cx, cy;
+
+    cx = (int)floor((xs-gx0)/cell);
+    cy = (int)floor((ys-gy0)/cell);
+    r0 = cx<0 ? -cx : cx>=gw ? cx-gw+1 : 0;	/* the first ring in the grid */
+    i = cy<0 ? -cy : cy>=gh ? cy-gh+1 : 0;
+    if( i>r0 ) r0 = i;
+    rmax = abs(cx);			/* enough rings to cover the grid */
+    if( abs(gw-1-cx) > rmax ) rmax = abs(gw-1-cx);
+    if( abs(cy) > rmax ) rmax = abs(cy);
+    if( abs(gh-1-cy) > rmax ) rmax = abs(gh-1-cy);
+
+    /* search rings of buckets around (cx,cy); the samples in ring r and */
+    /* beyond are more than (r-1)*cell away */
+    for(r=r0; r<=rmax; r++) {
+	if( n==k && best[k-1] < (r-1)*cell )
+	    break;
+	for(j=(cy-r<0 ? 0 : cy-r); j<=cy+r && j<gh; j++)
+	    if( j==cy-r || j==cy+r )
+		for(i=(cx-r<0 ? 0 : cx-r); i<=cx+r && i<gw; i++)
+		    consider_bucket(i, j, xs, ys, best, besti, &n);
+	    else {
+		consider_bucket(cx-r, j, xs, ys, best, besti, &n);
+		consider_bucket(cx+r, j, xs, ys, best, besti, &n);
+	    }
     }
 
-    dem_x = (float *)malloc( sizeof( float ) );
-    dem_y = (float *)malloc( sizeof( float ) );
-    dem_z = (float *)malloc( sizeof( float ) );
-
-
-
-    for(i=0; i<4; i++)
-    {
-	fscanf( fin, "%f", &x);
-	fscanf( fin, "%f", &y);
-	xul = min( xul, x);
-	yul = max( yul, y);
-	xlr = max( xlr, x);
-	ylr = min( ylr, y);
+    for(q=0; q<n; q++) {
+	if( best[q]==0 )		/* right on a sample */
+	    return pts[besti[q]].z;
+	w = power==1 ? 1/best[q] : pow(best[q], -power);
+	sum += pts[besti[q]].z*w;
+	wsum += w;
     }
+    return sum/wsum;
+}
 
-    printf("DEM Dimensions are [%.3f, %.3f] --> [%.3f, %.3f]\n", xul, yul, xlr, ylr);
-
-    fscanf(fin, "%f", &emin);     /* Throw away the min and max */
-    fscanf(fin, "%f", &emax);
-
-    fscanf( fin, "%d", &xmax );   /* How many profiles are there in total? */
-
-    for( i=0; i<xmax; i++)       /* Lets read in all of the data cleanly */
-    {
-	printf(".");
-	fscanf(fin, "%d", &num);   /* read in profile number */
-	fscanf( fin, "%d", &num);  /* read in the number of elements */
+/*------------------------------------------------------------*/
+void *resample_rows(void *arg)
+{
+    int x, y;
 
-	dem_x = (float *)realloc( dem_x, (count+num)*sizeof(float) );
-	dem_y = (float *)realloc( dem_y, (count+num)*sizeof(float) );
-	dem_z = (float *)realloc( dem_z, (count+num)*sizeof(float) );
+    for(;;) {
+	pthread_mutex_lock(&row_lock);
+	y = next_row++;
+	pthread_mutex_unlock(&row_lock);
+	if( y>=height ) break;
 
-	fscanf( fin, "%f %f", &startx, &starty );   /* read in X & Y coords */
-	for( x = 0; x<num; x++)  /* read in the data */
-	{
-	    fscanf(fin, "%d", &elev);
-	    dem_x[count] = startx;
-	    dem_y[count] = starty;
-	    dem_z[count] = (float)elev;
+	for(x=0; x<width; x++)
+	    out[(long)y*width + x] = (int)estimate(xul + x*out_spacing,
+						   yul - y*out_spacing);
+    }
+    return NULL;
+}
 
-	    /*  printf("[%f, %f] --> %f\n", dem_x[count], dem_y[count], dem_z[count]);  */
-			
-	    count++;
-	    starty = starty+30.0;
+/*-----------------------------------------------------*/
+void resample_DEM(char *filename)
+{
+    FILE *fout;
+    pthread_t *threads;
+    STMdata stm;
+    int i, x, y;
+
+    width = height = 0;
+    while( xul + width*out_spacing < xlr ) width++;	/* 30 m steps east */
+    while( yul - height*out_spacing > ylr ) height++;	/* and south */
+    out = (unsigned short *)xmalloc((long)width*height*sizeof(unsigned short));
+
+#ifdef _SC_NPROCESSORS_ONLN
+    if( nthreads<=0 )
+	nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if( nthreads<=0 )
+	nthreads = 1;
+    threads = (pthread_t *)xmalloc(nthreads*sizeof(pthread_t));
+    for(i=1; i<nthreads; i++)
+	pthread_create(&threads[i], NULL, resample_rows, NULL);
+    resample_rows(NULL);
+    for(i=1; i<nthreads; i++)
+	pthread_join(threads[i], NULL);
+
+    if( (fout = fopen(filename, text ? "w" : "wb"))==NULL ) {
+	fprintf(stderr, "resample: can't create %s\n", filename);
+	exit(1);
+    }
+    if( text ) {
+	for(y=0; y<height; y++) {
+	    for(x=0; x<width; x++)
+		fprintf(fout, "%d ", (short)out[(long)y*width + x]);
+	    fprintf(fout, "\n");
 	}
-
+    } else {
+	stm.data = out;
+	stm.width = width;
+	stm.height = height;
+	stmWrite(fout, &stm);
     }
-
-    fclose( fin );          /* end of reading in all of the data */
-
-    return;
+    if( fclose(fout) ) {
+	fprintf(stderr, "resample: error writing %s\n", filename);
+	exit(1);
+    }
+    fprintf(stderr, "%d points resampled to %dx%d\n", count, width, height);
 }
 
-/*-------------------------------------------------------*/
-float distance( float x1, float y1, float x2, float y2)
+/*-----------------------------------------------*/
+void usage(void)
 {
-    float d1, d2, d;
-
-    d1 = x2-x1;
-    d2 = y2-y1;
-    d = d1*d1+d2*d2;
-    d = sqrt(d );
-    return( d );
+    fprintf(stderr,
+	"usage: resample [-s spacing] [-S spacing] [-k k] [-p power]\n"
+	"                [-t threads] [-text] output input.dat\n");
+    exit(1);
 }
 
-
-/*-----------------------------------------------------*/
-void resample_DEM( void )
+int main(int argc, char *argv[])
 {
-    int i, j, q;
-    float xs, ys;
-    char filename[80];
-    float px[7], py[7], pz[7];
-    float dist, d[7];
-    float px1, py1;
-
-    if( ! command )
-    {
-	printf("\nPlease Enter the name of the output file\n");
-	scanf("%s", filename );
-    }
-    else
-    {
-	strcpy( filename, fileout );
-    }
-
-    if( (fout=fopen( filename, "wt") ) == NULL )
-    {
-	printf("Can't create %s\n", filename);
-	exit(0);
-    }
-
-    for( ys = yul; ys>ylr; ys=ys-30.0  )    /* do 30 m horizontal steps */
-    {
-	total3 = total2; total2  = total1;  total1 = 0.0;
-
-	for( xs = xul; xs<xlr; xs=xs+30.0)
-	{
-	    /* printf("Calculating for [%f, %f]\n", xs, ys); */
-	    for( q=0; q<6; q++)
-		d[q]=FLT_MAX;
-
-	    for(i=0; i<count; i++)    /* Check ALL of the data points */
-	    {
-		px1 = dem_x[i]; py1 = dem_y[i];
-		dist = distance( px1, py1, xs, ys);
-
-		for( j=0; j<6; j++)   /* check to see if this is closer */
-		{
-		    if( dist < d[j] )  /* it is closer! */
-		    {
-			/* printf("Dist = %f vs %f\n", dist, d[j]); */
-			/* printf("Point[%d]=%.3f, %.3f, D=%.3f\n",i, px1, py1, dist);  */
-			for( q = 5; q>j; q--)   /* move the rest off! */ 
-			{
-			    d[q+1] = d[q];
-			    px[q+1] = px[q];
-			    py[q+1] = py[q];
-			    pz[q+1] = pz[q];
-			}             /* End q */
-			d[j] = dist;
-			px[j] = dem_x[i];
-			py[j] = dem_y[i];
-			pz[j] = dem_z[i];
-			goto outofj;
-		    }  /* endif */
-
-		} /* end j */
-	    outofj:
-	    }  /* end i */
-
-	    px1 = (pz[0]/d[0])+(pz[1]/d[1])+(pz[2]/d[2])+(pz[3]/d[3])+(pz[4]/d[4])+(pz[5]/d[5]);
-	    px1 = px1/((1/d[0])+(1/d[1])+(1/d[2])+(1/d[3])+(1/d[4])+(1/d[5]) );
-	    total1 = total1+px1;        /* add to the total distance */
-
-	    /*		 printf("Estimate Elevation = %f\n", px1); */
-
-	    fprintf(fout, "%d ", (int)px1);      /* save the elevation */
-	    fflush(fout);
-
-	}   /* end xs */
-	fprintf(fout, "\n");
-    }    /* end ys */
-
-    fclose(fout);
-    return;
+    int i;
+
+    for(i=1; i<argc && argv[i][0]=='-'; i++) {
+	if( !strcmp(argv[i], "-text") )
+	    text = 1;
+	else if( i+1<argc && !strcmp(argv[i], "-s") )
+	    out_spacing = atof(argv[++i]);
+	else if( i+1<argc && !strcmp(argv[i], "-S") )
+	    in_spacing = atof(argv[++i]);
+	else if( i+1<argc && !strcmp(argv[i], "-k") )
+	    k = atoi(argv[++i]);
+	else if( i+1<argc && !strcmp(argv[i], "-p") )
+	    power = atof(argv[++i]);
+	else if( i+1<argc && !strcmp(argv[i], "-t") )
+	    nthreads = atoi(argv[++i]);
+	else
+	    usage();
+    }
+    if( argc-i != 2 || out_spacing<=0 || in_spacing<=0 || k<1 || k>MAX_K )
+	usage();
+
+    define_DEM(argv[i+1]);
+    if( count==0 ) {
+	fprintf(stderr, "resample: %s has no samples\n", argv[i+1]);
+	exit(1);
+    }
+    if( k>count ) k = count;
+    build_grid();
+    resample_DEM(argv[i]);
+
+    return 0;
 }
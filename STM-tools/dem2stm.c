@@ -0,0 +1,257 @@
+/*
+ * dem2stm -- convert USGS DEM files to STM
+ *
+ * Usage: dem2stm [-j jobs] file.dem ...
+ *
+ * Writes file.dem.stm for each file given.  Each profile of the DEM
+ * becomes a row of the STM, in order; all profiles must have the same
+ * number of points.  The elevations are stored as they are in the file.
+ *
+ * This does in one pass what convert and flat2stm used to do through
+ * a text file, and gives the same output.  The DEM is read through a
+ * large buffer and its fields are parsed by hand; only the handful of
+ * real numbers in the headers go through strtod (with FORTRAN's D
+ * exponents made E's).  Each profile is written as soon as it is read,
+ * so the memory used does not depend on the size of the DEM.
+ *
+ * When there are several files, each is converted by a process of its
+ * own, up to jobs of them at once (by default, one per processor).  A
+ * file that cannot be converted does not stop the others; the exit
+ * status is 1 if any failed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "stmops.h"
+
+#define BUFFER_SIZE 65536
+
+typedef struct {
+    FILE *in;
+    char *name;
+    char *output;	/* removed if the DEM cannot be read */
+    unsigned char buf[BUFFER_SIZE];
+    int pos, len;
+} DEMreader;
+
+static void fail(DEMreader *r, char *what)
+{
+    fprintf(stderr, "dem2stm: %s: %s\n", r->name, what);
+    unlink(r->output);
+    exit(1);
+}
+
+/* the next character of r, or EOF */
+static int next_char(DEMreader *r)
+{
+    if( r->pos==r->len ) {
+	r->len = fread(r->buf, 1, BUFFER_SIZE, r->in);
+	r->pos = 0;
+	if( r->len<=0 ) {
+	    r->len = 0;
+	    return EOF;
+	}
+    }
+    return r->buf[r->pos++];
+}
+
+static void skip_bytes(DEMreader *r, long n)
+{
+    while( n-- > 0 )
+	if( next_char(r)==EOF )
+	    fail(r, "file is too short");
+}
+
+/* the first character of the next field, which is not blank */
+static int field_start(DEMreader *r)
+{
+    int c;
+
+    do
+	c = next_char(r);
+    while( c!=EOF && isspace(c) );
+    if( c==EOF )
+	fail(r, "unexpected end of file");
+    return c;
+}
+
+static int read_int(DEMreader *r)
+{
+    int c = field_start(r), neg = 0, v = 0;
+
+    if( c=='-' || c=='+' ) {
+	neg = c=='-';
+	c = next_char(r);
+    }
+    if( c<'0' || c>'9' )
+	fail(r, "expected an integer");
+    for(; c>='0' && c<='9'; c=next_char(r))
+	v = 10*v + c-'0';
+    if( c!=EOF )
+	r->pos--;	/* leave the character that ended the field */
+    return neg ? -v : v;
+}
+
+/*
+ * Reads a real number as fscanf's %lf does, stopping where it would; the
+ * fields of a DEM are not always separated by blanks.
+ */
+static double read_real(DEMreader *r)
+{
+    char field[64];
+    char *end;
+    int c = field_start(r), n = 0, prev = 0, point = 0, exp = 0;
+    double v;
+
+    for(; c!=EOF; prev=c, c=next_char(r)) {
+	if( c=='+' || c=='-' ) {
+	    if( n && prev!='E' ) break;
+	} else if( c=='D' || c=='d' || c=='E' || c=='e' ) {
+	    if( exp ) break;
+	    c = 'E';
+	    exp = 1;
+	} else if( c=='.' ) {
+	    if( point || exp ) break;
+	    point = 1;
+	} else if( c<'0' || c>'9' )
+	    break;
+	if( n==sizeof field-1 )
+	    fail(r, "field too long");
+	field[n++] = c;
+    }
+    if( c!=EOF )
+	r->pos--;
+    field[n] = 0;
+    v = strtod(field, &end);
+    if( end==field )
+	fail(r, "expected a number");
+    return v;
+}
+
+/*
+ * The header (the type A record) and the profiles (type B records) are
+ * read field by field, as convert read them; the fields before the
+ * level code, at byte 145, are the name of the DEM.
+ */
+static int convert(char *demfile)
+{
+    DEMreader *r;
+    FILE *out;
+    char stmfile[1024];
+    int i, j, profiles, points, width = -1;
+    unsigned short *row = NULL;
+
+    if( strlen(demfile)+5 > sizeof stmfile ) {
+	fprintf(stderr, "dem2stm: %s: name too long\n", demfile);
+	return 1;
+    }
+    sprintf(stmfile, "%s.stm", demfile);
+
+    r = (DEMreader *)malloc(sizeof(DEMreader));
+    r->name = demfile;
+    r->output = stmfile;
+    r->pos = r->len = 0;
+    if( !(r->in = fopen(demfile, "rb")) ) {
+	fprintf(stderr, "dem2stm: cannot open %s\n", demfile);
+	free(r);
+	return 1;
+    }
+    if( !(out = fopen(stmfile, "wb")) ) {
+	fprintf(stderr, "dem2stm: cannot create %s\n", stmfile);
+	fclose(r->in);
+	free(r);
+	return 1;
+    }
+
+    skip_bytes(r, 145);
+    for(i=0;i<4;i++) read_int(r);	/* level, pattern, system, zone */
+    for(i=0;i<15;i++) read_real(r);	/* projection parameters */
+    for(i=0;i<3;i++) read_int(r);	/* units, number of sides */
+    for(i=0;i<8;i++) read_real(r);	/* corners */
+    for(i=0;i<3;i++) read_real(r);	/* min and max elevation, angle */
+    read_int(r);			/* accuracy code */
+    for(i=0;i<3;i++) read_real(r);	/* resolution */
+    read_int(r);			/* rows */
+    profiles = read_int(r);
+
+    for(j=0;j<profiles;j++) {
+	read_int(r); read_int(r);	/* row and column of the profile */
+	points = read_int(r);
+	read_int(r);
+	for(i=0;i<5;i++) read_real(r);	/* start, datum, min and max */
+
+	if( width<0 ) {
+	    width = points;
+	    stmWriteHeader(out, width, profiles);
+	    row = (unsigned short *)malloc(sizeof(unsigned short)*width);
+	} else if( points!=width )
+	    fail(r, "profiles of different sizes");
+
+	for(i=0;i<width;i++)
+	    row[i] = read_int(r);
+	stmWriteData(out, row, width);
+    }
+    if( width<0 )
+	fail(r, "no profiles");
+
+    fclose(r->in);
+    free(row);
+    free(r);
+    if( fclose(out) ) {
+	fprintf(stderr, "dem2stm: error writing %s\n", stmfile);
+	unlink(stmfile);
+	return 1;
+    }
+    return 0;
+}
+
+main(int ac, char **av)
+{
+    int i, jobs = 0, running = 0, failed = 0, status;
+    pid_t pid;
+
+    if( ac>2 && !strcmp(av[1], "-j") ) {
+	jobs = atoi(av[2]);
+	av += 2;
+	ac -= 2;
+    }
+    if( ac<2 ) {
+	fprintf(stderr, "usage: dem2stm [-j jobs] file.dem ...\n");
+	exit(1);
+    }
+    if( ac==2 )
+	exit(convert(av[1]));
+#ifdef _SC_NPROCESSORS_ONLN
+    if( jobs<=0 )
+	jobs = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if( jobs<=0 )
+	jobs = 1;
+
+    for(i=1;i<ac;i++) {
+	if( running==jobs ) {
+	    wait(&status);
+	    failed |= !WIFEXITED(status) || WEXITSTATUS(status);
+	    running--;
+	}
+	fflush(stderr);
+	pid = fork();
+	if( pid==0 )
+	    exit(convert(av[i]));
+	if( pid<0 ) {
+	    perror("dem2stm: fork");
+	    exit(1);
+	}
+	running++;
+    }
+    while( running-- > 0 ) {
+	wait(&status);
+	failed |= !WIFEXITED(status) || WEXITSTATUS(status);
+    }
+    exit(failed);
+}
@@ -3,6 +3,29 @@
 #include "stmops.h"
 #define ABS(a)          ((a)>=0 ? (a) : -(a))
 
+/* hash of lattice point (x,y) at octave o, uniform in [0,1) */
+static double lattice(int x, int y, int o) {
+    unsigned int h = x*374761393u + y*668265263u + o*2246822519u;
+    h = (h^(h>>13))*1274126177u;
+    return ((h^(h>>16)) & 0xffff)/65536.;
+}
+
+/* fractal terrain: value noise, each octave half the size and amplitude */
+static double fractal(int x, int y) {
+    double sum = 0, amp = 1, fx, fy, a, b;
+    int o, cell = 512, ix, iy;
+
+    for (o=0; o<8 && cell>=2; o++, cell/=2, amp/=2) {
+        ix = x/cell; iy = y/cell;
+        fx = (double)(x%cell)/cell; fy = (double)(y%cell)/cell;
+        fx = fx*fx*(3-2*fx); fy = fy*fy*(3-2*fy);
+        a = lattice(ix,iy,o) + fx*(lattice(ix+1,iy,o)-lattice(ix,iy,o));
+        b = lattice(ix,iy+1,o) + fx*(lattice(ix+1,iy+1,o)-lattice(ix,iy+1,o));
+        sum += amp*(a + fy*(b-a));
+    }
+    return sum/2;       /* the amplitudes add up to less than 2 */
+}
+
 main(int ac, char **av) {
     int nx, ny, x, y, style;
     short z;
@@ -60,6 +83,9 @@ main(int ac, char **av) {
                     sy = y-ny/2;
                     z = (sx*sx+sy*sy)*32767*4/(nx*nx+ny*ny);
                     break;
+                case 'f': /* fractal terrain, for benchmarks */
+                    z = 30000*fractal(x, y);
+                    break;
             }
             fwrite(&z, sizeof z, 1, stdout);
         }
@@ -5,6 +5,7 @@
 typedef unsigned short ushort;
 
 int exact = 0;
+int color = 0;		/* write a tinted PPM, for use as a texture */
 int min,max;
 
 STMdata *stm;
@@ -42,6 +43,29 @@ void pgm_write_pixel(FILE *out,unsigned int g)
 
 /* ----------------------------------------------------- */
 
+void ppm_raw_header(FILE *out,int width,int height)
+{
+    fprintf(out,"P6 %d %d 255\n",width,height);
+}
+
+void ppm_tint_pixel(FILE *out,unsigned char g)
+/* green lowlands through brown to white peaks */
+{
+    unsigned char rgb[3];
+
+    rgb[0] = 40 + g*215/255;
+    if( g<128 ) {
+	rgb[1] = 120 + g/2;
+	rgb[2] = 40;
+    } else {
+	rgb[1] = 184 + (g-128)/2;
+	rgb[2] = 40 + (g-128)*215/127;
+    }
+    fwrite(rgb,1,3,out);
+}
+
+/* ----------------------------------------------------- */
+
 
 void write_the_file()
 {
@@ -57,6 +81,8 @@ void write_the_file()
 
     if( exact )
 	pgm_write_header(stdout,stm->width,stm->height);
+    else if( color )
+	ppm_raw_header(stdout,stm->width,stm->height);
     else
 	pgm_raw_header(stdout,stm->width,stm->height);
 
@@ -70,7 +96,10 @@ void write_the_file()
 	    v /= max;
 
 	    c = (unsigned char)v;
-	    pgm_raw_pixel(stdout,c);
+	    if( color )
+		ppm_tint_pixel(stdout,c);
+	    else
+		pgm_raw_pixel(stdout,c);
 	}
     }
 
@@ -88,7 +117,7 @@ main(int argc,char **argv)
     int i;
 
     if( argc<2 ) {
-	fprintf(stderr,"usage: %s <infile>\n",argv[0]);
+	fprintf(stderr,"usage: %s <infile> [exact | color]\n",argv[0]);
 	exit(0);
     }
 
@@ -108,6 +137,8 @@ main(int argc,char **argv)
 	exact = 1;
 	fprintf(stderr,"Preserving exact data.\n");
     }
+    else if( argc>2 && !strcmp(argv[2],"color") )
+	color = 1;
 
     stm = stmRead(in);
     write_the_file();
@@ -0,0 +1,30 @@
+/*
+ * btin.h
+ *
+ * The binary TIN format written by scape -btin.  A BTIN file is:
+ *
+ *	a btinHeader,
+ *	nvertex vertices, each three floats: x, y, z,
+ *	ntriangle triangles, each three unsigned ints indexing the
+ *	vertices, counterclockwise seen from above.
+ *
+ * x and y are in samples of the height field, z is the height times
+ * heightscale, as in the text TIN format.  Everything is written in
+ * the byte order of the machine that wrote it; order holds BTIN_ORDER
+ * in that order, so a reader can tell whether it must swap bytes.
+ */
+
+#define BTIN_MAGIC "BTIN"
+#define BTIN_VERSION 1
+#define BTIN_ORDER 0x01020304
+
+typedef struct {
+    char magic[4];		/* BTIN_MAGIC */
+    unsigned int order;		/* BTIN_ORDER */
+    unsigned int version;	/* BTIN_VERSION */
+    unsigned int width, height;	/* of the height field */
+    unsigned int nvertex, ntriangle;
+    float heightscale;
+    float max_error;		/* largest error of the approximation */
+    float rms_error;		/* rms error, or -1 if not known */
+} btinHeader;
@@ -0,0 +1,125 @@
+/*
+ * btin2obj.c
+ *
+ * Converts binary TIN files (see btin.h) into Wavefront .OBJ, or with
+ * -ply, into binary PLY.  Vertices are shared, as they are in the
+ * BTIN file.
+ *
+ * Usage: btin2obj [-ply] [file.btin] > out.obj
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "btin.h"
+
+static void swap4(void *p, int n)
+{
+    unsigned char *b = (unsigned char *)p, t;
+    int i;
+
+    for(i=0;i<n;i++, b+=4) {
+	t = b[0]; b[0] = b[3]; b[3] = t;
+	t = b[1]; b[1] = b[2]; b[2] = t;
+    }
+}
+
+static void read_all(FILE *in, void *p, size_t size, size_t n)
+{
+    if( fread(p, size, n, in) != n ) {
+	fprintf(stderr, "btin2obj: file is truncated\n");
+	exit(1);
+    }
+}
+
+static int big_endian()
+{
+    unsigned int one = 1;
+    return *(unsigned char *)&one == 0;
+}
+
+static void write_obj(FILE *out, btinHeader *h, float *v, unsigned int *t)
+{
+    unsigned int i;
+
+    fprintf(out, "# %u vertices, %u triangles, max error %g\n",
+	    h->nvertex, h->ntriangle, h->max_error);
+    for(i=0;i<h->nvertex;i++, v+=3)
+	fprintf(out, "v %g %g %g\n", v[0], v[1], v[2]);
+
+    /* OBJ numbers vertices from 1 */
+    for(i=0;i<h->ntriangle;i++, t+=3)
+	fprintf(out, "f %u %u %u\n", t[0]+1, t[1]+1, t[2]+1);
+}
+
+static void write_ply(FILE *out, btinHeader *h, float *v, unsigned int *t)
+{
+    unsigned int i;
+    unsigned char three = 3;
+
+    fprintf(out, "ply\nformat %s 1.0\n",
+	    big_endian() ? "binary_big_endian" : "binary_little_endian");
+    fprintf(out, "comment max error %g\n", h->max_error);
+    fprintf(out, "element vertex %u\n", h->nvertex);
+    fprintf(out, "property float x\nproperty float y\nproperty float z\n");
+    fprintf(out, "element face %u\n", h->ntriangle);
+    fprintf(out, "property list uchar uint vertex_indices\nend_header\n");
+
+    fwrite(v, 3*sizeof(float), h->nvertex, out);
+    for(i=0;i<h->ntriangle;i++, t+=3) {
+	fwrite(&three, 1, 1, out);
+	fwrite(t, sizeof(unsigned int), 3, out);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    FILE *in = stdin;
+    btinHeader h;
+    float *v;
+    unsigned int *t;
+    int ply = 0, swap, i;
+
+    for(i=1;i<argc;i++) {
+	if( !strcmp(argv[i], "-ply") )
+	    ply = 1;
+	else if( !(in = fopen(argv[i], "rb")) ) {
+	    perror(argv[i]);
+	    exit(1);
+	}
+    }
+
+    read_all(in, &h, sizeof h, 1);
+    if( memcmp(h.magic, BTIN_MAGIC, 4) ) {
+	fprintf(stderr, "btin2obj: not a BTIN file\n");
+	exit(1);
+    }
+    swap = h.order != BTIN_ORDER;
+    if( swap )
+	swap4(&h.order, (sizeof h - 4)/4);
+    if( h.version != BTIN_VERSION ) {
+	fprintf(stderr, "btin2obj: unknown BTIN version %u\n", h.version);
+	exit(1);
+    }
+
+    v = (float *)malloc(3*sizeof(float)*(size_t)h.nvertex);
+    t = (unsigned int *)malloc(3*sizeof(unsigned int)*(size_t)h.ntriangle);
+    if( !v || !t ) {
+	fprintf(stderr, "btin2obj: out of memory\n");
+	exit(1);
+    }
+    read_all(in, v, 3*sizeof(float), h.nvertex);
+    read_all(in, t, 3*sizeof(unsigned int), h.ntriangle);
+    if( swap ) {
+	swap4(v, 3*h.nvertex);
+	swap4(t, 3*h.ntriangle);
+    }
+
+    setvbuf(stdout, NULL, _IOFBF, 1<<16);
+    if( ply )
+	write_ply(stdout, &h, v, t);
+    else
+	write_obj(stdout, &h, v, t);
+
+    return 0;
+}
@@ -0,0 +1,57 @@
+/*
+ * ptin.h
+ *
+ * The progressive TIN format written by scape -ptin.  It lists the
+ * vertices in the order they were inserted, each with the change it
+ * made to the triangulation, so that the mesh at any point count is
+ * had by reading the file up to that vertex.  A PTIN file is:
+ *
+ *	a ptinHeader,
+ *	nbase vertices of the starting mesh, each three floats: x, y, z,
+ *	nbasetri triangles of the starting mesh, each three unsigned
+ *	ints indexing the vertices,
+ *	for each vertex inserted after those, in order, a ptinRecord,
+ *	then nremoved unsigned ints, the numbers of the triangles the
+ *	vertex removed, then nadded triangles, three unsigned ints
+ *	each, that it added.
+ *
+ * Vertices are numbered from 0 in the order they appear, so the vertex
+ * of record k (from 0) is vertex nbase+k.  Triangles are numbered in
+ * the same way, the starting ones first, then the ones each record
+ * adds; a triangle that is removed is never added again.  Every
+ * triangle a record adds has its vertex as a corner, and is
+ * counterclockwise seen from above.
+ *
+ * error is the error of the vertex as a candidate when it was chosen.
+ * Ordinarily that is the largest error of the mesh the records before
+ * it make, so the mesh of the first k records has the error of record
+ * k+1 (or, after the last record, max_error).  When scape inserts in
+ * batches (-constthresh or -fracthresh), it holds only for the first
+ * vertex of each batch.
+ *
+ * x, y, z and the byte order are as in btin.h.  nvertex, ntriangle and
+ * max_error are filled in when the run ends; a file whose run did not
+ * end has zero nvertex, and its records go on to the end of the file.
+ */
+
+#define PTIN_MAGIC "PTIN"
+#define PTIN_VERSION 1
+#define PTIN_ORDER 0x01020304
+
+typedef struct {
+    char magic[4];		/* PTIN_MAGIC */
+    unsigned int order;		/* PTIN_ORDER */
+    unsigned int version;	/* PTIN_VERSION */
+    unsigned int width, height;	/* of the height field */
+    unsigned int nbase, nbasetri;	/* in the starting mesh */
+    unsigned int nvertex;	/* in all, the starting ones too */
+    unsigned int ntriangle;	/* numbered in all */
+    float heightscale;
+    float max_error;		/* of the mesh of all the records */
+} ptinHeader;
+
+typedef struct {
+    float x, y, z;
+    float error;		/* as a candidate, when it was chosen */
+    unsigned int nremoved, nadded;
+} ptinRecord;
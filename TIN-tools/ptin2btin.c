@@ -0,0 +1,171 @@
+/*
+ * ptin2btin.c
+ *
+ * Extracts the mesh at one level of detail from a progressive TIN (see
+ * ptin.h) as a binary TIN (see btin.h).  The records are replayed from
+ * the start of the file until the mesh has npoint points, or until its
+ * error is no more than maxerr; without either, all of them are.  The
+ * work and the memory are in proportion to the records read, not to
+ * the size of the file.
+ *
+ * Usage: ptin2btin [-n npoint] [-e maxerr] [file.ptin] > out.btin
+ *
+ * The error written in the BTIN header is that of the next vertex, which
+ * is the error of the mesh unless it was made by batched insertion.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ptin.h"
+#include "btin.h"
+
+static int swap;
+
+static void swap4(void *p, int n)
+{
+    unsigned char *b = (unsigned char *)p, t;
+    int i;
+
+    for(i=0;i<n;i++, b+=4) {
+	t = b[0]; b[0] = b[3]; b[3] = t;
+	t = b[1]; b[1] = b[2]; b[2] = t;
+    }
+}
+
+/* reads n items of 4-byte words, swapping them if need be */
+static void read_all(FILE *in, void *p, size_t size, size_t n)
+{
+    if( fread(p, size, n, in) != n ) {
+	fprintf(stderr, "ptin2btin: file is truncated\n");
+	exit(1);
+    }
+    if( swap )
+	swap4(p, size*n/4);
+}
+
+static void *grow(void *p, unsigned int *max, unsigned int need, size_t size)
+{
+    if( need <= *max )
+	return p;
+    while( *max < need )
+	*max = *max ? 2 * *max : 1024;
+    if( !(p = realloc(p, size * *max)) ) {
+	fprintf(stderr, "ptin2btin: out of memory\n");
+	exit(1);
+    }
+    return p;
+}
+
+int main(int argc, char **argv)
+{
+    FILE *in = stdin;
+    ptinHeader h;
+    ptinRecord r;
+    btinHeader b;
+    float *vert = NULL, error;
+    unsigned int *tri = NULL, *ids = NULL;
+    char *alive = NULL;
+    unsigned int nvert, ntri, nalive, maxvert = 0, maxtri = 0, maxalive = 0;
+    unsigned int maxids = 0, npoint = 0, i, k;
+    double maxerr = -1;
+    int more;
+
+    for(i=1;i<argc;i++) {
+	if( !strcmp(argv[i], "-n") && i+1<argc )
+	    npoint = atoi(argv[++i]);
+	else if( !strcmp(argv[i], "-e") && i+1<argc )
+	    maxerr = atof(argv[++i]);
+	else if( !(in = fopen(argv[i], "rb")) ) {
+	    perror(argv[i]);
+	    exit(1);
+	}
+    }
+
+    if( fread(&h, sizeof h, 1, in) != 1 || memcmp(h.magic, PTIN_MAGIC, 4) ) {
+	fprintf(stderr, "ptin2btin: not a PTIN file\n");
+	exit(1);
+    }
+    swap = h.order != PTIN_ORDER;
+    if( swap )
+	swap4(&h.order, (sizeof h - 4)/4);
+    if( h.version != PTIN_VERSION ) {
+	fprintf(stderr, "ptin2btin: unknown PTIN version %u\n", h.version);
+	exit(1);
+    }
+    if( npoint && npoint < h.nbase ) {
+	fprintf(stderr, "ptin2btin: the starting mesh has %u points\n",
+		h.nbase);
+	exit(1);
+    }
+
+    nvert = h.nbase;
+    ntri = nalive = h.nbasetri;
+    vert = (float *)grow(vert, &maxvert, nvert, 3*sizeof(float));
+    tri = (unsigned int *)grow(tri, &maxtri, ntri, 3*sizeof(unsigned int));
+    alive = (char *)grow(alive, &maxalive, ntri, 1);
+    read_all(in, vert, 3*sizeof(float), nvert);
+    read_all(in, tri, 3*sizeof(unsigned int), ntri);
+    memset(alive, 1, ntri);
+
+    /*
+     * Replay the records.  more is set if the record in r is one not
+     * applied; its error is then the error of the mesh.
+     */
+    for(;;) {
+	more = fread(&r, sizeof r, 1, in) == 1;
+	if( more && swap )
+	    swap4(&r, sizeof r/4);
+	if( !more || (npoint && nvert>=npoint)
+		|| (maxerr>=0 && r.error<=maxerr) )
+	    break;
+
+	vert = (float *)grow(vert, &maxvert, nvert+1, 3*sizeof(float));
+	vert[3*nvert] = r.x;
+	vert[3*nvert+1] = r.y;
+	vert[3*nvert+2] = r.z;
+	nvert++;
+
+	ids = (unsigned int *)grow(ids, &maxids, r.nremoved,
+				   sizeof(unsigned int));
+	read_all(in, ids, sizeof(unsigned int), r.nremoved);
+	for(k=0;k<r.nremoved;k++) {
+	    if( ids[k]>=ntri || !alive[ids[k]] ) {
+		fprintf(stderr, "ptin2btin: bad triangle %u in record %u\n",
+			ids[k], nvert-h.nbase-1);
+		exit(1);
+	    }
+	    alive[ids[k]] = 0;
+	}
+	nalive -= r.nremoved;
+
+	tri = (unsigned int *)grow(tri, &maxtri, ntri+r.nadded,
+				   3*sizeof(unsigned int));
+	alive = (char *)grow(alive, &maxalive, ntri+r.nadded, 1);
+	read_all(in, &tri[3*ntri], 3*sizeof(unsigned int), r.nadded);
+	memset(&alive[ntri], 1, r.nadded);
+	ntri += r.nadded;
+	nalive += r.nadded;
+    }
+    error = more ? r.error : h.nvertex ? h.max_error : -1;
+
+    memcpy(b.magic, BTIN_MAGIC, 4);
+    b.order = BTIN_ORDER;
+    b.version = BTIN_VERSION;
+    b.width = h.width;
+    b.height = h.height;
+    b.nvertex = nvert;
+    b.ntriangle = nalive;
+    b.heightscale = h.heightscale;
+    b.max_error = error;
+    b.rms_error = -1;
+
+    setvbuf(stdout, NULL, _IOFBF, 1<<16);
+    fwrite(&b, sizeof b, 1, stdout);
+    fwrite(vert, 3*sizeof(float), nvert, stdout);
+    for(i=0;i<ntri;i++)
+	if( alive[i] )
+	    fwrite(&tri[3*i], sizeof(unsigned int), 3, stdout);
+
+    return 0;
+}
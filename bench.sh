@@ -0,0 +1,133 @@
+#!/bin/sh
+#
+# bench.sh -- the SCAPE benchmark
+#
+# Runs scape over the sample terrains and over large synthetic ones
+# made by STM-tools/genstm, in Delaunay and data-dependent modes, with
+# each criterion, with and without texture, at several point counts.
+# Every run is repeated and the fastest kept; its -stats line (wall
+# clock time, insertions per second, pixels scanned per second, peak
+# memory and final error) goes to bench.out, one run per line:
+#
+#	run=<terrain>/<mode>/<npoint>/<tex|notex> file=... wall=... ...
+#
+# If bench.baseline exists (a bench.out saved from an earlier build),
+# each run is compared with it, and runs that have become slower by
+# more than the tolerance, or whose error has changed, are listed.  The
+# exit status is 1 if there were any.
+#
+# Usage: sh bench.sh [quick]
+#	quick: the samples only, once each
+#
+# Environment: BENCH_REPEAT (default 3), BENCH_TOLERANCE (default 0.10,
+# the allowed fractional increase of the insertion time), BENCH_THREADS
+# (passed to -threads; by default one per CPU).
+#
+
+REPEAT=${BENCH_REPEAT:-3}
+TOLERANCE=${BENCH_TOLERANCE:-0.10}
+QUICK=0
+if [ "$1" = quick ]; then QUICK=1; REPEAT=1; fi
+THREADS=
+if [ -n "$BENCH_THREADS" ]; then THREADS="-threads $BENCH_THREADS"; fi
+
+SCAPE=./scape
+OUT=bench.out
+DIR=bench
+
+if [ ! -x $SCAPE ]; then
+    echo "bench.sh: build scape first" >&2
+    exit 1
+fi
+(cd STM-tools; make genstm stm2pgm) > /dev/null || exit 1
+mkdir -p $DIR
+
+# texture for terrain $1, made from its own heights
+texture() {
+    ppm=$DIR/`basename $1 .stm`.ppm
+    if [ ! -f $ppm ]; then
+	STM-tools/stm2pgm $1 color > $ppm 2> /dev/null
+    fi
+    echo $ppm
+}
+
+# bench <stm> <npoint> <mode> <tex|notex>
+bench() {
+    stm=$1; npoint=$2; mode=$3; tex=$4
+    case $mode in
+	delaunay) opts="" ;;
+	*) opts="-datadep -$mode" ;;
+    esac
+    if [ $tex = tex ]; then
+	opts="$opts -tex `texture $stm` 0.5"
+    fi
+    name=`basename $stm .stm`/$mode/$npoint/$tex
+
+    i=0
+    while [ $i -lt $REPEAT ]; do
+	$SCAPE $stm -npoint $npoint $opts $THREADS -stats | sed -n 's/^# stats //p'
+	i=`expr $i + 1`
+    done | awk -v name=$name '
+	{ for(i=1;i<=NF;i++) { split($i, kv, "="); if( kv[1]=="insert_wall" ) t = kv[2] }
+	  if( best=="" || t<bt ) { best = $0; bt = t } }
+	END { if( best!="" ) print "run=" name, best }' >> $OUT
+    tail -1 $OUT | cut -c1-78
+}
+
+rm -f $OUT
+
+for stm in Samples/*.stm; do
+    for npoint in 1000 10000; do
+	for mode in delaunay sum max sqerr abn; do
+	    bench $stm $npoint $mode notex
+	done
+	bench $stm $npoint delaunay tex
+	bench $stm $npoint sqerr tex
+    done
+done
+
+if [ $QUICK = 0 ]; then
+    for size in 2000 4000; do
+	stm=$DIR/fractal$size.stm
+	if [ ! -f $stm ]; then
+	    STM-tools/genstm $size $size f > $stm
+	fi
+	for npoint in 10000 100000; do
+	    bench $stm $npoint delaunay notex
+	    bench $stm $npoint sqerr notex
+	done
+	bench $stm 10000 delaunay tex
+    done
+fi
+
+[ -f bench.baseline ] || exit 0
+
+echo
+echo "Compared with bench.baseline:"
+awk -v tol=$TOLERANCE '
+    function field(line, key,   n, i, f, kv) {
+	n = split(line, f, " ")
+	for(i=1;i<=n;i++) { split(f[i], kv, "="); if( kv[1]==key ) return kv[2] }
+	return ""
+    }
+    FNR==NR { base[field($0, "run")] = $0; next }
+    {
+	run = field($0, "run")
+	if( !(run in base) ) { print "  new: " run; next }
+	t = field($0, "insert_wall"); bt = field(base[run], "insert_wall")
+	r = field($0, "rms"); br = field(base[run], "rms")
+	n++
+	if( bt>0 ) { ratio = t/bt; logsum += log(ratio) }
+	if( bt>0 && ratio>1+tol ) {
+	    printf "  slower: %s %.3f s, was %.3f s (%+.0f%%)\n", run, t, bt, 100*(ratio-1)
+	    bad++
+	}
+	if( r!=br ) {
+	    printf "  error changed: %s rms %s, was %s\n", run, r, br
+	    bad++
+	}
+    }
+    END {
+	if( n ) printf "  %d runs, insertion time %.3f times the baseline (geometric mean)\n", n, exp(logsum/n)
+	exit bad>0
+    }' bench.baseline $OUT
@@ -0,0 +1,63 @@
+#!/bin/sh
+#
+# check.sh -- checks that -resume gives the same mesh as a straight run
+#
+# Each check simplifies a sample to 2000 points with -checkpoint, resumes
+# from the checkpoint to 4000 points, and compares the triangles of the
+# result with those of a run that did not stop.  The options of the two
+# halves may differ in ways that must not change the mesh, such as
+# -lazyscan, which a checkpoint records and a resumed run takes up.  The
+# exit status is 1 if any check failed.
+#
+# Usage: sh check.sh
+#
+
+SCAPE=./scape
+DIR=check
+STM=Samples/westUS.stm
+
+if [ ! -x $SCAPE ]; then
+    echo "check.sh: build scape first" >&2
+    exit 1
+fi
+mkdir -p $DIR
+failed=0
+
+# resumed <name> <options to 2000> <options from 2000 to 4000>
+# Makes $DIR/<name>.tin by way of a checkpoint at 2000 points.
+resumed() {
+    rm -f $DIR/$1.tin
+    $SCAPE $STM -npoint 2000 $2 -checkpoint $DIR/ck.bin > /dev/null &&
+    $SCAPE $STM -npoint 4000 $3 -resume $DIR/ck.bin > /dev/null &&
+    sort out.tin > $DIR/$1.tin
+}
+
+# check <name> <reference>
+check() {
+    if [ -s $DIR/$1.tin ] && cmp -s $DIR/$1.tin $DIR/$2.tin; then
+	echo "ok      $1"
+    else
+	echo "FAILED  $1"
+	failed=1
+    fi
+}
+
+$SCAPE $STM -npoint 4000 > /dev/null && sort out.tin > $DIR/straight.tin
+
+resumed same "" ""
+check same straight
+resumed lazy-both "-lazyscan" "-lazyscan"
+check lazy-both straight
+resumed lazy-first "-lazyscan" ""
+check lazy-first straight
+resumed lazy-second "" "-lazyscan"
+check lazy-second straight
+
+# batched from the checkpoint on, which gives the same mesh whether or
+# not the first half scanned lazily
+resumed batch "" "-fracthresh .5"
+resumed lazy-batch "-lazyscan" "-fracthresh .5"
+check lazy-batch batch
+
+rm -f $DIR/ck.bin
+exit $failed